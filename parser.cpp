@@ -4,6 +4,19 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <exception>
+#include <utility>
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#define JSON_HAS_COROUTINES
+#endif
 using namespace std;
 
 enum class TokenType {
@@ -362,18 +375,812 @@ void printJson(const JsonValue& value, int indent = 0) {
     }
 }
 
+JsonValue parseJson(const string &json) {
+    Tokenizer tokenizer(json);
+    Parser parser(tokenizer);
+    return parser.parseValue();
+}
+
+// 128-bit non-cryptographic hash of a byte range, consumed 8 bytes at a time
+// in two independent lanes. Fast enough to run on every incoming payload.
+struct Hash128 {
+    uint64_t lo = 0, hi = 0;
+    bool operator==(const Hash128 &o) const { return lo == o.lo && hi == o.hi; }
+};
+
+struct Hash128Hasher {
+    size_t operator()(const Hash128 &h) const { return h.lo; }
+};
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+Hash128 hashBytes(const char *data, size_t len, uint64_t seed = 0) {
+    const uint64_t k1 = 0x9e3779b97f4a7c15ULL, k2 = 0xc2b2ae3d27d4eb4fULL;
+    uint64_t a = seed ^ k1, b = seed ^ k2 ^ len;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint64_t w1, w2;
+        memcpy(&w1, data + i, 8);
+        memcpy(&w2, data + i + 8, 8);
+        a = (a ^ w1) * k2;
+        a = (a << 31) | (a >> 33);
+        b = (b ^ w2) * k1;
+        b = (b << 29) | (b >> 35);
+        a += b;
+        b += a;
+    }
+    uint64_t tail[2] = {0, 0};
+    memcpy(tail, data + i, len - i);
+    a = (a ^ tail[0]) * k2;
+    b = (b ^ tail[1]) * k1;
+    a += b;
+    b += a;
+    a = mix64(a);
+    b = mix64(b + a);
+    return {a, b};
+}
+
+// Rough heap footprint of a parsed value, used to charge cache entries
+size_t jsonFootprint(const JsonValue &value) {
+    size_t bytes = sizeof(JsonValue);
+    if (holds_alternative<string>(value.value)) {
+        bytes += get<string>(value.value).capacity();
+    }
+    else if (holds_alternative<JsonObject>(value.value)) {
+        const auto &obj = get<JsonObject>(value.value);
+        bytes += obj.bucket_count() * sizeof(void*);
+        for (const auto &[key, val] : obj) {
+            bytes += 2 * sizeof(void*) + key.capacity() + jsonFootprint(val);
+        }
+    }
+    else if (holds_alternative<JsonArray>(value.value)) {
+        const auto &arr = get<JsonArray>(value.value);
+        bytes += (arr.capacity() - arr.size()) * sizeof(JsonValue);
+        for (const auto &val : arr) bytes += jsonFootprint(val);
+    }
+    return bytes;
+}
+
+// LRU cache of parsed documents keyed by a hash of the input bytes. Entries
+// are shared and immutable, so hits hand out the same tree to every caller.
+// Keys are spread over independently locked shards to keep contention low.
+// The byte budget is shared by all shards: an insert first evicts least
+// recently used entries from its own shard, then from the others if the
+// cache is still over budget. Documents larger than the whole budget are
+// returned uncached and counted in Stats::oversized.
+//
+// Inputs are never compared byte for byte: a hit means the 128-bit hash and
+// the length match. The hash is seeded randomly per cache so senders cannot
+// precompute collisions, but it is not cryptographic; don't share one cache
+// between callers that must not see each other's documents.
+class ParseCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t oversized = 0; // parsed but too large to cache
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit ParseCache(size_t byteBudget, size_t shardCount = 16)
+        : budget(byteBudget), seed((uint64_t(random_device()()) << 32) ^ random_device()()) {
+        for (size_t i = 0; i < max<size_t>(shardCount, 1); i++) {
+            shards.push_back(make_unique<Shard>());
+        }
+    }
+
+    // Returns the parsed document for json, parsing it on a miss.
+    // Throws like Parser does if json is invalid; failures are not cached.
+    shared_ptr<const JsonValue> get(const string &json) {
+        Hash128 key = hashBytes(json.data(), json.size(), seed);
+        size_t owner = key.hi % shards.size();
+        Shard &shard = *shards[owner];
+        {
+            lock_guard<mutex> lock(shard.m);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end() && it->second->length == json.size()) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                hits.fetch_add(1, memory_order_relaxed);
+                return it->second->doc;
+            }
+        }
+        misses.fetch_add(1, memory_order_relaxed);
+
+        // Parse outside the lock so a large document doesn't stall the shard
+        auto doc = make_shared<const JsonValue>(parseJson(json));
+        size_t bytes = jsonFootprint(*doc);
+        if (bytes > budget) {
+            oversized.fetch_add(1, memory_order_relaxed);
+            return doc;
+        }
+
+        {
+            lock_guard<mutex> lock(shard.m);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end()) {
+                // Raced with another parse, or a hash collision: keep the cached entry
+                return it->second->length == json.size() ? it->second->doc : doc;
+            }
+            shard.lru.push_front({key, json.size(), doc, bytes});
+            shard.index[key] = shard.lru.begin();
+            shard.bytes += bytes;
+            totalBytes.fetch_add(bytes, memory_order_relaxed);
+            while (overBudget() && shard.lru.size() > 1) evictLast(shard);
+        }
+
+        // Still over: take the rest from the other shards, one lock at a time
+        for (size_t i = 1; i < shards.size() && overBudget(); i++) {
+            Shard &other = *shards[(owner + i) % shards.size()];
+            lock_guard<mutex> lock(other.m);
+            while (overBudget() && !other.lru.empty()) evictLast(other);
+        }
+        return doc;
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.hits = hits.load(memory_order_relaxed);
+        s.misses = misses.load(memory_order_relaxed);
+        s.evictions = evictions.load(memory_order_relaxed);
+        s.oversized = oversized.load(memory_order_relaxed);
+        for (const auto &shard : shards) {
+            lock_guard<mutex> lock(shard->m);
+            s.entries += shard->lru.size();
+            s.bytes += shard->bytes;
+        }
+        return s;
+    }
+
+    void clear() {
+        for (auto &shard : shards) {
+            lock_guard<mutex> lock(shard->m);
+            shard->index.clear();
+            shard->lru.clear();
+            totalBytes.fetch_sub(shard->bytes, memory_order_relaxed);
+            shard->bytes = 0;
+        }
+    }
+
+private:
+    struct Entry {
+        Hash128 key;
+        size_t length; // input size, checked on every hit
+        shared_ptr<const JsonValue> doc;
+        size_t bytes;
+    };
+
+    struct Shard {
+        mutable mutex m;
+        list<Entry> lru; // most recently used first
+        unordered_map<Hash128, list<Entry>::iterator, Hash128Hasher> index;
+        size_t bytes = 0;
+    };
+
+    bool overBudget() const { return totalBytes.load(memory_order_relaxed) > budget; }
+
+    // Caller holds shard.m
+    void evictLast(Shard &shard) {
+        Entry &victim = shard.lru.back();
+        shard.bytes -= victim.bytes;
+        totalBytes.fetch_sub(victim.bytes, memory_order_relaxed);
+        shard.index.erase(victim.key);
+        shard.lru.pop_back();
+        evictions.fetch_add(1, memory_order_relaxed);
+    }
+
+    vector<unique_ptr<Shard>> shards;
+    size_t budget;
+    uint64_t seed;
+    atomic<size_t> totalBytes{0};
+    atomic<uint64_t> hits{0}, misses{0}, evictions{0}, oversized{0};
+};
+
 bool parseNorm(const string &json) {
     try {
-        Tokenizer tokenizer(json);
-        Parser parser(tokenizer);
-        
-        JsonValue root = parser.parseValue();
+        JsonValue root = parseJson(json);
         return true; // successfully parsed
     } catch (...) {
         return false;
     }
 }
 
+bool parseNorm(const string &json, ParseCache &cache) {
+    try {
+        auto root = cache.get(json);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Push parser for input that arrives in pieces. feed() may be called with
+// chunks split anywhere (inside strings, numbers or literals); the lexer and
+// the container stack survive between calls, and finish() returns the value
+// once the last chunk is in. Completed tokens go through Tokenizer, so each
+// token is validated as Parser does. Unlike Parser, which stops after the
+// first value, anything but whitespace after it is rejected (e.g. "[1]x",
+// "{}{}"), and a run of number characters is one token, so "01" is invalid.
+class StreamParser {
+private:
+    enum class LexState { Idle, String, StringEscape, Number, Literal };
+    enum class Expect { Value, ValueOrEnd, Key, KeyOrEnd, Colon, CommaOrEnd, Done };
+
+    struct Frame {
+        JsonValue value; // JsonObject or JsonArray under construction
+        string key;      // pending key while parsing an object member
+    };
+
+    LexState lex = LexState::Idle;
+    string pending; // text of a token split across chunks
+    Expect expect = Expect::Value;
+    vector<Frame> stack;
+    JsonValue root;
+
+    static bool isNumberChar(char c) {
+        return isdigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    void flushPending() {
+        Tokenizer tokenizer(pending);
+        Token tok = tokenizer.nextToken();
+        if (tokenizer.nextToken().type != TokenType::EndOfFile) tok.type = TokenType::Invalid;
+        pending.clear();
+        lex = LexState::Idle;
+        onToken(tok);
+    }
+
+    void onValue(JsonValue value) {
+        if (stack.empty()) {
+            root = std::move(value);
+            expect = Expect::Done;
+            return;
+        }
+        Frame &top = stack.back();
+        if (holds_alternative<JsonObject>(top.value.value)) {
+            get<JsonObject>(top.value.value)[top.key] = std::move(value);
+        } else {
+            get<JsonArray>(top.value.value).push_back(std::move(value));
+        }
+        expect = Expect::CommaOrEnd;
+    }
+
+    void closeFrame() {
+        JsonValue value = std::move(stack.back().value);
+        stack.pop_back();
+        onValue(std::move(value));
+    }
+
+    void onToken(const Token &tok) {
+        switch (expect) {
+            case Expect::ValueOrEnd:
+                if (tok.type == TokenType::RightBracket) { closeFrame(); return; }
+                [[fallthrough]];
+            case Expect::Value:
+                switch (tok.type) {
+                    case TokenType::String: onValue(JsonValue{tok.value}); return;
+                    case TokenType::Number: onValue(JsonValue{stod(tok.value)}); return;
+                    case TokenType::True:   onValue(JsonValue{true}); return;
+                    case TokenType::False:  onValue(JsonValue{false}); return;
+                    case TokenType::Null:   onValue(JsonValue{nullptr}); return;
+                    case TokenType::LeftBrace:
+                        stack.push_back({JsonValue{JsonObject{}}, ""});
+                        expect = Expect::KeyOrEnd;
+                        return;
+                    case TokenType::LeftBracket:
+                        stack.push_back({JsonValue{JsonArray{}}, ""});
+                        expect = Expect::ValueOrEnd;
+                        return;
+                    default:
+                        throw runtime_error("Unexpected token in parseValue");
+                }
+            case Expect::KeyOrEnd:
+                if (tok.type == TokenType::RightBrace) { closeFrame(); return; }
+                [[fallthrough]];
+            case Expect::Key:
+                if (tok.type != TokenType::String)
+                    throw runtime_error("Expected string key in object");
+                stack.back().key = tok.value;
+                expect = Expect::Colon;
+                return;
+            case Expect::Colon:
+                if (tok.type != TokenType::Colon)
+                    throw runtime_error("Expected ':' after key");
+                expect = Expect::Value;
+                return;
+            case Expect::CommaOrEnd: {
+                bool inObject = holds_alternative<JsonObject>(stack.back().value.value);
+                if (tok.type == TokenType::Comma) {
+                    expect = inObject ? Expect::Key : Expect::Value;
+                } else if (tok.type == (inObject ? TokenType::RightBrace : TokenType::RightBracket)) {
+                    closeFrame();
+                } else {
+                    throw runtime_error(inObject ? "Expected ',' or '}' in object"
+                                                 : "Expected ',' or ']' in array");
+                }
+                return;
+            }
+            case Expect::Done:
+                throw runtime_error("Unexpected data after JSON value");
+        }
+    }
+
+public:
+    void feed(const char *data, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            char c = data[i];
+            switch (lex) {
+                case LexState::String:
+                    pending += c;
+                    if (c == '\\') lex = LexState::StringEscape;
+                    else if (c == '"') flushPending();
+                    continue;
+                case LexState::StringEscape:
+                    pending += c;
+                    lex = LexState::String;
+                    continue;
+                case LexState::Number:
+                    if (isNumberChar(c)) { pending += c; continue; }
+                    flushPending();
+                    break; // c still needs to be handled
+                case LexState::Literal:
+                    if (isalpha(c)) { pending += c; continue; }
+                    flushPending();
+                    break;
+                case LexState::Idle:
+                    break;
+            }
+
+            if (isspace(c)) continue;
+            switch (c) {
+                case '{': onToken({TokenType::LeftBrace, "{"}); break;
+                case '}': onToken({TokenType::RightBrace, "}"}); break;
+                case '[': onToken({TokenType::LeftBracket, "["}); break;
+                case ']': onToken({TokenType::RightBracket, "]"}); break;
+                case ':': onToken({TokenType::Colon, ":"}); break;
+                case ',': onToken({TokenType::Comma, ","}); break;
+                default:
+                    pending += c;
+                    if (c == '"') lex = LexState::String;
+                    else if (c == '-' || isdigit(c)) lex = LexState::Number;
+                    else if (isalpha(c)) lex = LexState::Literal;
+                    else flushPending(); // reports the invalid token
+            }
+        }
+    }
+
+    void feed(const string &chunk) { feed(chunk.data(), chunk.size()); }
+
+    // True once a complete top-level value has been seen
+    bool done() const { return expect == Expect::Done; }
+
+    // Call after the last chunk; throws if the document is incomplete
+    JsonValue finish() {
+        if (lex == LexState::Number || lex == LexState::Literal) flushPending();
+        if (lex != LexState::Idle) throw runtime_error("Unterminated string");
+        if (expect != Expect::Done) throw runtime_error("Unexpected end of input");
+        expect = Expect::Value;
+        return std::move(root);
+    }
+};
+
+#ifdef JSON_HAS_COROUTINES
+// Coroutine front end for async servers:
+//
+//     JsonValue body = co_await parseAsync(connection);
+//
+// Source::read() must return an awaitable that yields the next chunk as a
+// string, with an empty chunk marking the end of input. Chunks are fed as
+// they arrive, so parsing overlaps with receiving.
+class JsonTask {
+public:
+    struct promise_type {
+        JsonValue result;
+        exception_ptr error;
+        coroutine_handle<> continuation;
+        bool taken = false;
+
+        JsonTask get_return_object() {
+            return JsonTask(coroutine_handle<promise_type>::from_promise(*this));
+        }
+        suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            coroutine_handle<> await_suspend(coroutine_handle<promise_type> h) noexcept {
+                auto next = h.promise().continuation;
+                return next ? next : noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_value(JsonValue value) { result = std::move(value); }
+        void unhandled_exception() { error = current_exception(); }
+    };
+
+    JsonTask(JsonTask &&other) noexcept : handle(exchange(other.handle, {})) {}
+    JsonTask(const JsonTask&) = delete;
+    ~JsonTask() { if (handle) handle.destroy(); }
+
+    bool await_ready() const noexcept { return false; }
+    coroutine_handle<> await_suspend(coroutine_handle<> awaiting) {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    JsonValue await_resume() { return take(); }
+
+    // For callers that are not coroutines: start() runs until the first
+    // suspension, and take() returns the result once done() is true. take()
+    // moves the result out, so it may be called only once; calling it early
+    // or twice throws.
+    void start() { handle.resume(); }
+    bool done() const { return handle.done(); }
+    JsonValue take() {
+        if (!handle || !handle.done()) throw runtime_error("JsonTask::take() called before the task finished");
+        promise_type &p = handle.promise();
+        if (p.taken) throw runtime_error("JsonTask::take() called twice");
+        p.taken = true;
+        if (p.error) rethrow_exception(p.error);
+        return std::move(p.result);
+    }
+
+private:
+    explicit JsonTask(coroutine_handle<promise_type> h) : handle(h) {}
+    coroutine_handle<promise_type> handle;
+};
+
+template <class Source>
+JsonTask parseAsync(Source &source) {
+    StreamParser parser;
+    while (true) {
+        string chunk = co_await source.read();
+        if (chunk.empty()) break;
+        parser.feed(chunk);
+    }
+    co_return parser.finish();
+}
+#endif
+
+// Deep equality; numbers compare as doubles and object key order is irrelevant
+bool jsonEquals(const JsonValue &a, const JsonValue &b) {
+    if (a.value.index() != b.value.index()) return false;
+    if (holds_alternative<JsonObject>(a.value)) {
+        const auto &x = get<JsonObject>(a.value);
+        const auto &y = get<JsonObject>(b.value);
+        if (x.size() != y.size()) return false;
+        for (const auto &[key, val] : x) {
+            auto it = y.find(key);
+            if (it == y.end() || !jsonEquals(val, it->second)) return false;
+        }
+        return true;
+    }
+    if (holds_alternative<JsonArray>(a.value)) {
+        const auto &x = get<JsonArray>(a.value);
+        const auto &y = get<JsonArray>(b.value);
+        if (x.size() != y.size()) return false;
+        for (size_t i = 0; i < x.size(); i++) {
+            if (!jsonEquals(x[i], y[i])) return false;
+        }
+        return true;
+    }
+    if (holds_alternative<string>(a.value)) return get<string>(a.value) == get<string>(b.value);
+    if (holds_alternative<double>(a.value)) return get<double>(a.value) == get<double>(b.value);
+    if (holds_alternative<bool>(a.value)) return get<bool>(a.value) == get<bool>(b.value);
+    return true; // null
+}
+
+// ---- JSON Pointer (RFC 6901) and JSON Patch (RFC 6902) ----
+//
+// All edits happen in place on the existing tree: only the containers along
+// the pointer path are touched, and moved subtrees are moved, not copied.
+
+vector<string> splitPointer(const string &pointer) {
+    vector<string> tokens;
+    if (pointer.empty()) return tokens;
+    if (pointer[0] != '/') throw runtime_error("JSON Pointer must start with '/': " + pointer);
+    string token;
+    for (size_t i = 1; i <= pointer.size(); i++) {
+        if (i == pointer.size() || pointer[i] == '/') {
+            tokens.push_back(token);
+            token.clear();
+        } else if (pointer[i] == '~') {
+            char next = i + 1 < pointer.size() ? pointer[++i] : '\0';
+            if (next == '0') token += '~';
+            else if (next == '1') token += '/';
+            else throw runtime_error("Invalid escape in JSON Pointer: " + pointer);
+        } else {
+            token += pointer[i];
+        }
+    }
+    return tokens;
+}
+
+// Array index token: digits without leading zeros, fitting in size_t
+bool parseIndex(const string &token, size_t &index) {
+    if (token.empty() || (token.size() > 1 && token[0] == '0')) return false;
+    index = 0;
+    for (char c : token) {
+        if (!isdigit(c)) return false;
+        size_t digit = c - '0';
+        if (index > (SIZE_MAX - digit) / 10) return false; // would wrap to a small index
+        index = index * 10 + digit;
+    }
+    return true;
+}
+
+JsonValue *findChild(JsonValue &parent, const string &token) {
+    if (holds_alternative<JsonObject>(parent.value)) {
+        auto &obj = get<JsonObject>(parent.value);
+        auto it = obj.find(token);
+        return it == obj.end() ? nullptr : &it->second;
+    }
+    if (holds_alternative<JsonArray>(parent.value)) {
+        auto &arr = get<JsonArray>(parent.value);
+        size_t index;
+        if (!parseIndex(token, index) || index >= arr.size()) return nullptr;
+        return &arr[index];
+    }
+    return nullptr;
+}
+
+JsonValue *findPath(JsonValue &doc, const vector<string> &tokens, size_t count) {
+    JsonValue *cur = &doc;
+    for (size_t i = 0; i < count && cur; i++) cur = findChild(*cur, tokens[i]);
+    return cur;
+}
+
+// Value at pointer, or nullptr if there is none
+JsonValue *findPointer(JsonValue &doc, const string &pointer) {
+    auto tokens = splitPointer(pointer);
+    return findPath(doc, tokens, tokens.size());
+}
+
+// Patch "add": sets an object member, or inserts into an array ("-" appends).
+// value is moved from only after every check has passed, so when this throws
+// the caller still owns it.
+void insertAt(JsonValue &doc, const string &pointer, JsonValue &value) {
+    auto tokens = splitPointer(pointer);
+    if (tokens.empty()) {
+        doc = std::move(value);
+        return;
+    }
+    JsonValue *parent = findPath(doc, tokens, tokens.size() - 1);
+    if (!parent) throw runtime_error("Path not found: " + pointer);
+    const string &last = tokens.back();
+    if (holds_alternative<JsonObject>(parent->value)) {
+        get<JsonObject>(parent->value)[last] = std::move(value);
+    } else if (holds_alternative<JsonArray>(parent->value)) {
+        auto &arr = get<JsonArray>(parent->value);
+        size_t index = arr.size();
+        if (last != "-" && (!parseIndex(last, index) || index > arr.size())) {
+            throw runtime_error("Array index out of range: " + pointer);
+        }
+        arr.insert(arr.begin() + index, std::move(value));
+    } else {
+        throw runtime_error("Cannot add to a scalar: " + pointer);
+    }
+}
+
+void addAt(JsonValue &doc, const string &pointer, JsonValue value) {
+    insertAt(doc, pointer, value);
+}
+
+// Patch "remove": detaches the value at pointer and returns it
+JsonValue removeAt(JsonValue &doc, const string &pointer) {
+    auto tokens = splitPointer(pointer);
+    if (tokens.empty()) throw runtime_error("Cannot remove the document root");
+    JsonValue *parent = findPath(doc, tokens, tokens.size() - 1);
+    JsonValue *target = parent ? findChild(*parent, tokens.back()) : nullptr;
+    if (!target) throw runtime_error("Path not found: " + pointer);
+    JsonValue removed = std::move(*target);
+    if (holds_alternative<JsonObject>(parent->value)) {
+        get<JsonObject>(parent->value).erase(tokens.back());
+    } else {
+        auto &arr = get<JsonArray>(parent->value);
+        arr.erase(arr.begin() + (target - arr.data()));
+    }
+    return removed;
+}
+
+// Patch "replace": the target must already exist
+void replaceAt(JsonValue &doc, const string &pointer, JsonValue value) {
+    JsonValue *target = findPointer(doc, pointer);
+    if (!target) throw runtime_error("Path not found: " + pointer);
+    *target = std::move(value);
+}
+
+JsonValue &patchMember(JsonObject &op, const string &name) {
+    auto it = op.find(name);
+    if (it == op.end()) throw runtime_error("Patch operation is missing '" + name + "'");
+    return it->second;
+}
+
+const string &patchString(JsonObject &op, const string &name) {
+    JsonValue &v = patchMember(op, name);
+    if (!holds_alternative<string>(v.value)) throw runtime_error("Patch member '" + name + "' must be a string");
+    return get<string>(v.value);
+}
+
+// Applies an RFC 6902 patch document (an array of operations) to doc in
+// place. Values are moved out of the patch, so pass it with std::move to
+// avoid copies. Throws on the first failing operation; the operations before
+// it stay applied, so patch a copy if all-or-nothing is required.
+void applyPatch(JsonValue &doc, JsonValue patch) {
+    if (!holds_alternative<JsonArray>(patch.value)) throw runtime_error("JSON Patch must be an array");
+    for (auto &entry : get<JsonArray>(patch.value)) {
+        if (!holds_alternative<JsonObject>(entry.value)) throw runtime_error("Patch operation must be an object");
+        auto &op = get<JsonObject>(entry.value);
+        const string &name = patchString(op, "op");
+        const string &path = patchString(op, "path");
+
+        if (name == "add") {
+            addAt(doc, path, std::move(patchMember(op, "value")));
+        } else if (name == "remove") {
+            removeAt(doc, path);
+        } else if (name == "replace") {
+            replaceAt(doc, path, std::move(patchMember(op, "value")));
+        } else if (name == "move") {
+            const string &from = patchString(op, "from");
+            if (path.compare(0, from.size(), from) == 0 && path.size() > from.size() && path[from.size()] == '/') {
+                throw runtime_error("Cannot move a value into itself: " + from);
+            }
+            if (from == path) {
+                // A no-op, but RFC 6902 still requires the source to exist
+                if (!findPointer(doc, from)) throw runtime_error("Path not found: " + from);
+            } else {
+                // path is resolved after the removal (RFC 6902 4.4); if it
+                // turns out to be invalid, put the value back where it was
+                JsonValue moved = removeAt(doc, from);
+                try {
+                    insertAt(doc, path, moved);
+                } catch (...) {
+                    insertAt(doc, from, moved);
+                    throw;
+                }
+            }
+        } else if (name == "copy") {
+            JsonValue *source = findPointer(doc, patchString(op, "from"));
+            if (!source) throw runtime_error("Path not found: " + patchString(op, "from"));
+            addAt(doc, path, *source);
+        } else if (name == "test") {
+            JsonValue *target = findPointer(doc, path);
+            if (!target || !jsonEquals(*target, patchMember(op, "value"))) {
+                throw runtime_error("Test failed: " + path);
+            }
+        } else {
+            throw runtime_error("Unknown patch operation: " + name);
+        }
+    }
+}
+
+void applyPatch(JsonValue &doc, const string &patchJson) {
+    applyPatch(doc, parseJson(patchJson));
+}
+
+// ---- Structural hashing, equality and diff ----
+//
+// jsonHash() hashes the parsed tree directly, with no canonical
+// re-serialization: strings go through hashBytes(), numbers are hashed as
+// normalized doubles (so 1, 1.0 and 1e0 collide, as do 0 and -0), and object
+// members are combined with addition so key order does not matter.
+
+uint64_t jsonHash(const JsonValue &value) {
+    const uint64_t k = 0x9e3779b97f4a7c15ULL;
+    if (holds_alternative<nullptr_t>(value.value)) return mix64(1);
+    if (holds_alternative<bool>(value.value)) return mix64(get<bool>(value.value) ? 2 : 3);
+    if (holds_alternative<double>(value.value)) {
+        double d = get<double>(value.value);
+        if (d == 0) d = 0; // fold -0 into 0
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        return mix64(bits ^ 4 * k);
+    }
+    if (holds_alternative<string>(value.value)) {
+        const string &s = get<string>(value.value);
+        return hashBytes(s.data(), s.size(), 5).lo;
+    }
+    if (holds_alternative<JsonObject>(value.value)) {
+        const auto &obj = get<JsonObject>(value.value);
+        uint64_t sum = 0;
+        for (const auto &[key, val] : obj) {
+            uint64_t h = jsonHash(val);
+            sum += mix64(hashBytes(key.data(), key.size(), 6).lo ^ ((h << 17) | (h >> 47)));
+        }
+        return mix64(sum ^ obj.size() * k);
+    }
+    const auto &arr = get<JsonArray>(value.value);
+    uint64_t h = 7;
+    for (const auto &val : arr) h = mix64(h * k + jsonHash(val));
+    return mix64(h ^ arr.size());
+}
+
+// Hash of a raw buffer; parses but never re-serializes
+uint64_t jsonHash(const string &json) {
+    return jsonHash(parseJson(json));
+}
+
+// Structural equality of two raw buffers. Identical bytes are parsed once,
+// so invalid input throws whether or not the buffers match.
+bool jsonEquals(const string &a, const string &b) {
+    if (a == b) {
+        parseJson(a);
+        return true;
+    }
+    return jsonEquals(parseJson(a), parseJson(b));
+}
+
+string escapePointerToken(const string &token) {
+    string out;
+    for (char c : token) {
+        if (c == '~') out += "~0";
+        else if (c == '/') out += "~1";
+        else out += c;
+    }
+    return out;
+}
+
+JsonValue patchOp(const string &op, const string &path, const JsonValue *value = nullptr) {
+    JsonObject obj;
+    obj["op"] = JsonValue{op};
+    obj["path"] = JsonValue{path};
+    if (value) obj["value"] = *value;
+    return JsonValue{std::move(obj)};
+}
+
+void diffInto(const JsonValue &from, const JsonValue &to, const string &path, JsonArray &ops) {
+    if (from.value.index() != to.value.index()) {
+        ops.push_back(patchOp("replace", path, &to));
+    }
+    else if (holds_alternative<JsonObject>(from.value)) {
+        const auto &a = get<JsonObject>(from.value);
+        const auto &b = get<JsonObject>(to.value);
+        for (const auto &[key, val] : a) {
+            string child = path + "/" + escapePointerToken(key);
+            auto it = b.find(key);
+            if (it == b.end()) ops.push_back(patchOp("remove", child));
+            else diffInto(val, it->second, child, ops);
+        }
+        for (const auto &[key, val] : b) {
+            if (!a.count(key)) ops.push_back(patchOp("add", path + "/" + escapePointerToken(key), &val));
+        }
+    }
+    else if (holds_alternative<JsonArray>(from.value)) {
+        const auto &a = get<JsonArray>(from.value);
+        const auto &b = get<JsonArray>(to.value);
+        size_t common = min(a.size(), b.size());
+        for (size_t i = 0; i < common; i++) diffInto(a[i], b[i], path + "/" + to_string(i), ops);
+        for (size_t i = a.size(); i > common; i--) ops.push_back(patchOp("remove", path + "/" + to_string(i - 1)));
+        for (size_t i = common; i < b.size(); i++) ops.push_back(patchOp("add", path + "/-", &b[i]));
+    }
+    else if (!jsonEquals(from, to)) {
+        ops.push_back(patchOp("replace", path, &to));
+    }
+}
+
+// JSON Patch that turns `from` into `to` when passed to applyPatch()
+JsonValue jsonDiff(const JsonValue &from, const JsonValue &to) {
+    JsonArray ops;
+    diffInto(from, to, "", ops);
+    return JsonValue{std::move(ops)};
+}
+
+JsonValue jsonDiff(const string &from, const string &to) {
+    if (from == to) {
+        parseJson(from); // validate, as the slow path would
+        return JsonValue{JsonArray{}};
+    }
+    return jsonDiff(parseJson(from), parseJson(to));
+}
+
 // int main() {
 //     string json = R"({
 //         "person": {
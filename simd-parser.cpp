@@ -1,39 +1,313 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <exception>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 using namespace std;
 
-// Function to find structural character positions
-vector<size_t> find_structurals(const string &json) {
-    vector<size_t> structurals;
+// Appends structural character positions in json[begin, end)
+void find_structurals_range(const string &json, size_t begin, size_t end,
+                            vector<size_t> &structurals) {
     const string chars = "{}[]:,\"";
 
     // Process in blocks of 16 chars (SIMD would do parallel compares)
     size_t block_size = 16;
-    for (size_t i = 0; i < json.size(); i += block_size) {
-        size_t end = min(i + block_size, json.size());
+    for (size_t i = begin; i < end; i += block_size) {
+        size_t block_end = min(i + block_size, end);
         
-        for (size_t j = i; j < end; j++) {
+        for (size_t j = i; j < block_end; j++) {
             if (chars.find(json[j]) != string::npos) {
                 structurals.push_back(j);
             }
         }
     }
+}
+
+// Function to find structural character positions
+vector<size_t> find_structurals(const string &json) {
+    vector<size_t> structurals;
+    find_structurals_range(json, 0, json.size(), structurals);
+    return structurals;
+}
+
+// Per-byte bitmasks for one 64-byte block (bit k describes byte k)
+struct BlockMasks {
+    uint64_t quote;      // unescaped quotes
+    uint64_t inString;   // inside a string: opening quote included, closing quote excluded
+    uint64_t space;      // whitespace
+    uint64_t structural; // { } [ ] : , regardless of string state
+};
+
+// Stage 1 scanner that tracks string state across blocks. Each call to next()
+// classifies up to 64 bytes; the escape and in-string state carry over.
+struct StringScanner {
+    bool prevEscaped = false;  // first byte of the next block is escaped
+    uint64_t prevInString = 0; // all ones if the previous block ended inside a string
+
+    static void classify(const char *p, uint64_t &backslash, uint64_t &quote,
+                         uint64_t &space, uint64_t &structural) {
+#ifdef __SSE2__
+        backslash = quote = space = structural = 0;
+        for (int k = 0; k < 4; k++) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+            auto eq = [&](char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); };
+            auto bits = [&](__m128i m) { return uint64_t(uint16_t(_mm_movemask_epi8(m))) << (16 * k); };
+            backslash |= bits(eq('\\'));
+            quote |= bits(eq('"'));
+            space |= bits(_mm_or_si128(_mm_or_si128(eq(' '), eq('\n')), _mm_or_si128(eq('\t'), eq('\r'))));
+            structural |= bits(_mm_or_si128(_mm_or_si128(_mm_or_si128(eq('{'), eq('}')), _mm_or_si128(eq('['), eq(']'))),
+                                            _mm_or_si128(eq(':'), eq(','))));
+        }
+#else
+        backslash = quote = space = structural = 0;
+        for (int k = 0; k < 64; k++) {
+            uint64_t bit = uint64_t(1) << k;
+            switch (p[k]) {
+                case '\\': backslash |= bit; break;
+                case '"': quote |= bit; break;
+                case ' ': case '\n': case '\t': case '\r': space |= bit; break;
+                case '{': case '}': case '[': case ']': case ':': case ',': structural |= bit; break;
+            }
+        }
+#endif
+    }
+
+    // Bits of the bytes escaped by a backslash. Backslashes are rare, so this
+    // walks them one at a time instead of using carry tricks.
+    uint64_t findEscaped(uint64_t backslash) {
+        uint64_t escaped = prevEscaped ? 1 : 0;
+        backslash &= ~escaped; // an escaped backslash escapes nothing
+        prevEscaped = false;
+        while (backslash) {
+            int k = __builtin_ctzll(backslash);
+            if (k == 63) {
+                prevEscaped = true;
+                break;
+            }
+            escaped |= uint64_t(1) << (k + 1);
+            backslash &= ~(uint64_t(3) << k);
+        }
+        return escaped;
+    }
+
+    // Bit k set if an odd number of bits at positions <= k are set
+    static uint64_t prefixXor(uint64_t x) {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    // len < 64 only for the final block; missing bytes are treated as spaces
+    BlockMasks next(const char *p, size_t len = 64) {
+        char padded[64];
+        if (len < 64) {
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, p, len);
+            p = padded;
+        }
+        uint64_t backslash, quote, space, structural;
+        classify(p, backslash, quote, space, structural);
+        quote &= ~findEscaped(backslash);
+        uint64_t inString = prefixXor(quote) ^ prevInString;
+        prevInString = uint64_t(int64_t(inString) >> 63);
+        return {quote, inString, space, structural};
+    }
+};
+
+// ---- Parallel stage 1 for one large document ----
+
+const size_t PARALLEL_MIN_BYTES = 1 << 20; // below this, threads cost more than they save
+
+unsigned parallelThreads(unsigned threads) {
+    return threads ? threads : max(1u, thread::hardware_concurrency());
+}
+
+// Splits [0, size) into about `parts` ranges on 64-byte block boundaries
+vector<size_t> chunkBounds(size_t size, unsigned parts) {
+    vector<size_t> bounds{0};
+    size_t step = (size / parts + 63) & ~size_t(63);
+    for (size_t b = step; step && b < size; b += step) bounds.push_back(b);
+    bounds.push_back(size);
+    return bounds;
+}
+
+// Runs f(0) .. f(n - 1) on n threads and rethrows the first failure
+template <class F>
+void runParallel(size_t n, F f) {
+    vector<thread> workers;
+    vector<exception_ptr> errors(n);
+    for (size_t i = 0; i < n; i++) {
+        workers.emplace_back([&, i] {
+            try { f(i); } catch (...) { errors[i] = current_exception(); }
+        });
+    }
+    for (auto &w : workers) w.join();
+    for (auto &e : errors) {
+        if (e) rethrow_exception(e);
+    }
+}
+
+// Whether json[pos] is escaped, i.e. preceded by an odd run of backslashes
+bool escapedAt(const string &json, size_t pos) {
+    size_t run = 0;
+    while (pos > run && json[pos - run - 1] == '\\') run++;
+    return run % 2 == 1;
+}
+
+// Same result as find_structurals, one chunk per thread
+vector<size_t> find_structurals_parallel(const string &json, unsigned threads = 0) {
+    threads = parallelThreads(threads);
+    if (threads == 1 || json.size() < PARALLEL_MIN_BYTES) return find_structurals(json);
+    auto bounds = chunkBounds(json.size(), threads);
+    vector<vector<size_t>> parts(bounds.size() - 1);
+    runParallel(parts.size(), [&](size_t c) {
+        find_structurals_range(json, bounds[c], bounds[c + 1], parts[c]);
+    });
+    vector<size_t> structurals;
+    size_t total = 0;
+    for (auto &p : parts) total += p.size();
+    structurals.reserve(total);
+    for (auto &p : parts) structurals.insert(structurals.end(), p.begin(), p.end());
     return structurals;
 }
 
+// What a chunk does to string state and nesting depth. A chunk is scanned
+// once assuming it starts outside a string; starting inside just inverts its
+// in-string mask, so the depth change for both cases comes from one pass.
+struct ChunkSummary {
+    bool flipsString = false; // odd number of unescaped quotes
+    long depthIfOutside = 0;  // net opens minus closes when starting outside a string
+    long depthIfInside = 0;   // same when starting inside one
+};
+
+ChunkSummary summarizeChunk(const string &json, size_t begin, size_t end) {
+    ChunkSummary sum;
+    StringScanner scanner;
+    scanner.prevEscaped = escapedAt(json, begin);
+    for (size_t i = begin; i < end; i += 64) {
+        BlockMasks m = scanner.next(json.data() + i, min<size_t>(64, end - i));
+        for (uint64_t bits = m.structural; bits; bits &= bits - 1) {
+            char c = json[i + __builtin_ctzll(bits)];
+            int delta = (c == '{' || c == '[') ? 1 : (c == '}' || c == ']') ? -1 : 0;
+            if ((m.inString & bits & -bits) == 0) sum.depthIfOutside += delta;
+            else sum.depthIfInside += delta;
+        }
+    }
+    sum.flipsString = scanner.prevInString != 0;
+    return sum;
+}
+
+// First comma in [begin, end) that separates elements of the root array,
+// given the string state and depth at begin, or string::npos
+size_t findTopLevelComma(const string &json, size_t begin, size_t end, bool inString, long depth) {
+    StringScanner scanner;
+    scanner.prevEscaped = escapedAt(json, begin);
+    scanner.prevInString = inString ? UINT64_MAX : 0;
+    for (size_t i = begin; i < end; i += 64) {
+        BlockMasks m = scanner.next(json.data() + i, min<size_t>(64, end - i));
+        for (uint64_t bits = m.structural & ~m.inString; bits; bits &= bits - 1) {
+            size_t pos = i + __builtin_ctzll(bits);
+            char c = json[pos];
+            if (c == '{' || c == '[') depth++;
+            else if (c == '}' || c == ']') depth--;
+            else if (c == ',' && depth == 1) return pos;
+        }
+    }
+    return string::npos;
+}
+
 struct Token {
     string type;
     string value;
 };
 
+// Interns object keys as small integer ids. A table can be shared by many
+// documents (e.g. all records of an NDJSON stream), so each distinct key is
+// stored once and field lookups compare ids instead of strings.
+struct KeyTable {
+    static constexpr uint32_t NO_KEY = UINT32_MAX;
+
+    unordered_map<string, uint32_t> ids;
+    vector<const string*> names; // id -> key (points into ids, which never moves its nodes)
+
+    KeyTable() = default;
+    KeyTable(KeyTable&&) = default; // moving the map keeps its nodes, so names stay valid
+    KeyTable &operator=(KeyTable&&) = default;
+
+    // A copy owns new nodes, so names must be rebuilt to point into them
+    KeyTable(const KeyTable &other) : ids(other.ids) { rebuildNames(); }
+    KeyTable &operator=(const KeyTable &other) {
+        if (this != &other) {
+            ids = other.ids;
+            rebuildNames();
+        }
+        return *this;
+    }
+
+    void rebuildNames() {
+        names.assign(ids.size(), nullptr);
+        for (auto &kv : ids) names[kv.second] = &kv.first;
+    }
+
+    uint32_t intern(const string &key) {
+        auto it = ids.find(key);
+        if (it != ids.end()) return it->second;
+        uint32_t id = names.size();
+        auto inserted = ids.emplace(key, id).first;
+        names.push_back(&inserted->first);
+        return id;
+    }
+
+    // Id of an already interned key, or NO_KEY
+    uint32_t lookup(const string &key) const {
+        auto it = ids.find(key);
+        return it != ids.end() ? it->second : NO_KEY;
+    }
+
+    const string &name(uint32_t id) const { return *names[id]; }
+    size_t size() const { return names.size(); }
+};
+
 struct Node {
     string type;  // Object, Array, String, Number, True, False, Null
     string value;
-    vector<pair<string, Node>> obj; // object fields
-    vector<Node> arr;               // array elements
+    vector<pair<uint32_t, Node>> obj; // object fields, keyed by KeyTable id
+    vector<Node> arr;                 // array elements
 };
 
+// Field lookup by interned key: a linear scan over integer ids
+const Node *getField(const Node &n, uint32_t key) {
+    for (auto &kv : n.obj) {
+        if (kv.first == key) return &kv.second;
+    }
+    return nullptr;
+}
+
+const Node *getField(const Node &n, const KeyTable &keys, const string &key) {
+    uint32_t id = keys.lookup(key);
+    return id == KeyTable::NO_KEY ? nullptr : getField(n, id);
+}
+
 // string extractString(const string &json, size_t &pos) {
 //     string result;
 //     pos++; // skip opening "
@@ -131,7 +405,10 @@ string extractLiteral(const string &json, size_t &pos) {
 //     return tokens;
 // }
 
-vector<Token> parseJsonWithIndex(const string &json, const vector<size_t> &structurals) {
+// limit bounds the scalar scan after the last structural when tokenizing
+// only part of the document
+vector<Token> parseJsonWithIndex(const string &json, const vector<size_t> &structurals,
+                                 size_t limit = string::npos) {
     vector<Token> tokens;
 
     for (size_t i = 0; i < structurals.size(); i++) {
@@ -155,7 +432,7 @@ vector<Token> parseJsonWithIndex(const string &json, const vector<size_t> &struc
         }
 
         // Now check the gap *after* this structural, until the next structural
-        size_t next = (i + 1 < structurals.size()) ? structurals[i+1] : json.size();
+        size_t next = (i + 1 < structurals.size()) ? structurals[i+1] : min(limit, json.size());
         size_t j = pos + 1;
 
         while (j < next) {
@@ -229,6 +506,13 @@ vector<Token> parseJsonWithIndex(const string &json, const vector<size_t> &struc
 struct Parser {
     vector<Token> tokens;
     size_t pos = 0;
+    KeyTable *keys = nullptr; // shared intern table; falls back to ownKeys
+    KeyTable ownKeys;
+
+    Parser(vector<Token> tokens, size_t pos = 0, KeyTable *keys = nullptr)
+        : tokens(std::move(tokens)), pos(pos), keys(keys) {}
+
+    KeyTable &table() { return keys ? *keys : ownKeys; }
 
     Token peek() {
         if (pos >= tokens.size()) throw runtime_error("peek(): out of token range");
@@ -267,8 +551,8 @@ struct Parser {
                 throw runtime_error("Expected ':' after key, got: " + peek().type);
             }
             get(); // consume ':'
-            Node value = parseValue();
-            n.obj.push_back({key.value, value});
+            uint32_t id = table().intern(key.value);
+            n.obj.push_back({id, parseValue()});
             if (peek().type == "Comma") get();
         }
         get(); // consume '}'
@@ -280,8 +564,7 @@ struct Parser {
         Node n; n.type = "Array";
 
         while (peek().type != "RightBracket") {
-            Node value = parseValue();
-            n.arr.push_back(value);
+            n.arr.push_back(parseValue());
             if (peek().type == "Comma") get();
         }
         get(); // consume ']'
@@ -289,14 +572,14 @@ struct Parser {
     }
 };
 
-void printNode(const Node &n, int indent=0) {
+void printNode(const Node &n, const KeyTable &keys, int indent=0) {
     string pad(indent, ' ');
     if (n.type == "Object") {
         cout << "{\n";
         for (size_t i = 0; i < n.obj.size(); i++) {
             auto &kv = n.obj[i];
-            cout << pad << "  \"" << kv.first << "\": ";
-            printNode(kv.second, indent + 2);
+            cout << pad << "  \"" << keys.name(kv.first) << "\": ";
+            printNode(kv.second, keys, indent + 2);
             if (i + 1 < n.obj.size()) cout << ",";
             cout << "\n";
         }
@@ -306,7 +589,7 @@ void printNode(const Node &n, int indent=0) {
         cout << "[\n";
         for (size_t i = 0; i < n.arr.size(); i++) {
             cout << pad << "  ";
-            printNode(n.arr[i], indent + 2);
+            printNode(n.arr[i], keys, indent + 2);
             if (i + 1 < n.arr.size()) cout << ",";
             cout << "\n";
         }
@@ -319,16 +602,17 @@ void printNode(const Node &n, int indent=0) {
     }
 }
 
-bool parseSimd(const string &json) {
+// Parses json into a Node tree whose keys are interned in keys; throws on error
+Node parseSimdTree(const string &json, KeyTable &keys) {
+    auto structurals = find_structurals(json);
+    if (structurals.empty()) throw runtime_error("No structurals found!");
+    Parser p{parseJsonWithIndex(json, structurals), 0, &keys};
+    return p.parseValue();
+}
+
+bool parseSimd(const string &json, KeyTable &keys) {
     try {
-        auto structurals = find_structurals(json);
-        if (structurals.empty()) {
-            std::cerr << "[SIMD Parser] No structurals found!\n";
-            return false;
-        }
-        auto tokens = parseJsonWithIndex(json, structurals);
-        Parser p{tokens};
-        Node root = p.parseValue();
+        Node root = parseSimdTree(json, keys);
         return true; // successfully parsed
     } catch (const std::exception &e) {
         std::cerr << "[SIMD Parser] Exception: " << e.what() << "\n";
@@ -343,6 +627,762 @@ bool parseSimd(const string &json) {
     }
 }
 
+bool parseSimd(const string &json) {
+    KeyTable keys;
+    return parseSimd(json, keys);
+}
+
+// Rewrites key ids after a subtree was parsed against a different KeyTable
+void remapKeys(Node &n, const vector<uint32_t> &ids) {
+    for (auto &kv : n.obj) {
+        kv.first = ids[kv.first];
+        remapKeys(kv.second, ids);
+    }
+    for (auto &e : n.arr) remapKeys(e, ids);
+}
+
+// Parses a large document whose root is an array on several threads. Stage 1
+// scans one chunk per thread, a sequential fix-up chains the chunks' string
+// state and depth, each chunk then finds a top-level comma to split at, and
+// stage 2 parses each run of elements with its own Parser and KeyTable.
+// Small documents and non-array roots use the sequential parser.
+Node parseSimdParallel(const string &json, KeyTable &keys, unsigned threads = 0) {
+    threads = parallelThreads(threads);
+    size_t first = json.find_first_not_of(" \t\n\r");
+    size_t last = json.find_last_not_of(" \t\n\r");
+    if (threads == 1 || json.size() < PARALLEL_MIN_BYTES || first == string::npos ||
+        json[first] != '[' || json[last] != ']') {
+        return parseSimdTree(json, keys);
+    }
+
+    auto bounds = chunkBounds(json.size(), threads);
+    size_t chunks = bounds.size() - 1;
+    vector<vector<size_t>> found(chunks);
+    vector<ChunkSummary> sums(chunks);
+    runParallel(chunks, [&](size_t c) {
+        find_structurals_range(json, bounds[c], bounds[c + 1], found[c]);
+        sums[c] = summarizeChunk(json, bounds[c], bounds[c + 1]);
+    });
+
+    vector<size_t> structurals;
+    for (auto &f : found) {
+        structurals.insert(structurals.end(), f.begin(), f.end());
+        vector<size_t>().swap(f);
+    }
+
+    // Fix-up: resolve where each chunk really starts
+    vector<bool> startInString(chunks);
+    vector<long> startDepth(chunks);
+    for (size_t c = 1; c < chunks; c++) {
+        bool in = startInString[c - 1];
+        startInString[c] = in != sums[c - 1].flipsString;
+        startDepth[c] = startDepth[c - 1] + (in ? sums[c - 1].depthIfInside : sums[c - 1].depthIfOutside);
+    }
+
+    vector<size_t> splits(chunks, string::npos);
+    runParallel(chunks - 1, [&](size_t c) {
+        c++;
+        splits[c] = findTopLevelComma(json, bounds[c], bounds[c + 1], startInString[c], startDepth[c]);
+    });
+    vector<size_t> cuts{first};
+    for (size_t s : splits) {
+        if (s != string::npos && s > cuts.back() && s < last) cuts.push_back(s);
+    }
+    cuts.push_back(last);
+
+    // Stage 2: each part is "[" or "," followed by whole elements
+    size_t parts = cuts.size() - 1;
+    vector<vector<Node>> elems(parts);
+    vector<KeyTable> tables(parts);
+    runParallel(parts, [&](size_t k) {
+        auto lo = lower_bound(structurals.begin(), structurals.end(), cuts[k]);
+        auto hi = lower_bound(structurals.begin(), structurals.end(), cuts[k + 1]);
+        Parser p{parseJsonWithIndex(json, vector<size_t>(lo, hi), cuts[k + 1]), 1, &tables[k]};
+        // Separators are optional here because Parser::parseArray doesn't
+        // require them either; both paths must accept the same documents
+        while (p.pos < p.tokens.size()) {
+            elems[k].push_back(p.parseValue());
+            if (p.pos < p.tokens.size() && p.peek().type == "Comma") p.get();
+        }
+    });
+
+    vector<vector<uint32_t>> ids(parts);
+    for (size_t k = 0; k < parts; k++) {
+        for (uint32_t id = 0; id < tables[k].size(); id++) ids[k].push_back(keys.intern(tables[k].name(id)));
+    }
+    runParallel(parts, [&](size_t k) {
+        for (auto &e : elems[k]) remapKeys(e, ids[k]);
+    });
+
+    Node root;
+    root.type = "Array";
+    size_t total = 0;
+    for (auto &e : elems) total += e.size();
+    root.arr.reserve(total);
+    for (auto &e : elems) {
+        for (auto &n : e) root.arr.push_back(std::move(n));
+    }
+    return root;
+}
+
+// ---- Tape: flat, pointer-free form of a parsed document ----
+//
+// Each value is one or more 64-bit words: the top byte is a tag and the low
+// 56 bits a payload. Containers store the index of their matching close word
+// so a whole subtree can be skipped in O(1); strings and numbers store an
+// offset into the string buffer, where they sit as a 32-bit length + bytes.
+// Nothing in a tape is a pointer, so it can be written to disk and mapped back
+// at any address. Object fields are a key string word followed by the value.
+
+enum class TapeTag : uint8_t {
+    Object = '{', ObjectEnd = '}',
+    Array = '[', ArrayEnd = ']',
+    String = '"', Number = 'd',
+    True = 't', False = 'f', Null = 'n'
+};
+
+const uint64_t TAPE_PAYLOAD_MASK = (uint64_t(1) << 56) - 1;
+
+uint64_t tapeWord(TapeTag tag, uint64_t payload) {
+    return (uint64_t(tag) << 56) | payload;
+}
+
+// Non-owning view of a tape; the same accessors work on an in-memory Tape and
+// on a file mapped with loadTape()
+struct TapeView {
+    const uint64_t *words = nullptr;
+    size_t size = 0;
+    const char *strings = nullptr;
+    size_t stringsSize = 0;
+};
+
+struct TapeRef {
+    const TapeView *tape;
+    size_t idx;
+
+    TapeTag tag() const { return TapeTag(tape->words[idx] >> 56); }
+    uint64_t payload() const { return tape->words[idx] & TAPE_PAYLOAD_MASK; }
+
+    bool isObject() const { return tag() == TapeTag::Object; }
+    bool isArray() const { return tag() == TapeTag::Array; }
+    bool isString() const { return tag() == TapeTag::String; }
+    bool isNumber() const { return tag() == TapeTag::Number; }
+    bool isNull() const { return tag() == TapeTag::Null; }
+    bool isBool() const { return tag() == TapeTag::True || tag() == TapeTag::False; }
+
+    bool getBool() const { return tag() == TapeTag::True; }
+
+    // Raw text of a String or Number, pointing straight into the string buffer
+    string_view getString() const {
+        const char *p = tape->strings + payload();
+        uint32_t len;
+        memcpy(&len, p, sizeof(len));
+        return string_view(p + sizeof(len), len);
+    }
+
+    // Parsed straight from the buffer. Out-of-range values become +-inf (or
+    // +-0 on underflow) like stod's result; throws if the text is not a number.
+    double getNumber() const {
+        string_view text = getString();
+        double d = 0;
+        auto r = from_chars(text.data(), text.data() + text.size(), d);
+        if (r.ptr != text.data() + text.size() || (r.ec != errc() && r.ec != errc::result_out_of_range)) {
+            throw runtime_error("Invalid number on tape: " + string(text));
+        }
+        if (r.ec == errc::result_out_of_range) {
+            return strtod(string(text).c_str(), nullptr); // rare; strtod picks inf or 0
+        }
+        return d;
+    }
+
+    // The value that follows this one (skips whole containers)
+    TapeRef next() const {
+        if (isObject() || isArray()) return {tape, payload() + 1};
+        return {tape, idx + 1};
+    }
+
+    // Number of array elements or object fields
+    size_t count() const {
+        size_t n = 0;
+        size_t end = payload();
+        for (TapeRef c{tape, idx + 1}; c.idx < end; c = c.next()) {
+            if (isObject()) c = c.next(); // skip key
+            n++;
+        }
+        return n;
+    }
+
+    bool at(size_t i, TapeRef &out) const {
+        if (!isArray()) return false;
+        size_t end = payload();
+        for (TapeRef c{tape, idx + 1}; c.idx < end; c = c.next()) {
+            if (i-- == 0) { out = c; return true; }
+        }
+        return false;
+    }
+
+    bool field(string_view key, TapeRef &out) const {
+        if (!isObject()) return false;
+        size_t end = payload();
+        for (TapeRef c{tape, idx + 1}; c.idx < end; c = c.next()) {
+            TapeRef value{tape, c.idx + 1};
+            if (c.isString() && c.getString() == key) { out = value; return true; }
+            c = value;
+        }
+        return false;
+    }
+};
+
+struct Tape {
+    vector<uint64_t> words;
+    string strings;
+
+    TapeView view() const { return {words.data(), words.size(), strings.data(), strings.size()}; }
+};
+
+struct TapeBuilder {
+    Tape &tape;
+    const KeyTable &keys;
+    vector<uint64_t> keyOffsets; // KeyTable id -> string buffer offset, so each key is stored once
+
+    uint64_t addString(const string &s) {
+        uint64_t off = tape.strings.size();
+        uint32_t len = s.size();
+        tape.strings.append(reinterpret_cast<const char*>(&len), sizeof(len));
+        tape.strings += s;
+        return off;
+    }
+
+    void addKey(uint32_t id) {
+        if (id >= keyOffsets.size()) keyOffsets.resize(keys.size(), UINT64_MAX);
+        if (keyOffsets[id] == UINT64_MAX) keyOffsets[id] = addString(keys.name(id));
+        tape.words.push_back(tapeWord(TapeTag::String, keyOffsets[id]));
+    }
+
+    void add(const Node &n) {
+        if (n.type == "Object" || n.type == "Array") {
+            bool isObj = n.type == "Object";
+            size_t openIdx = tape.words.size();
+            tape.words.push_back(0); // patched once the close index is known
+            if (isObj) {
+                for (auto &kv : n.obj) {
+                    addKey(kv.first);
+                    add(kv.second);
+                }
+            } else {
+                for (auto &e : n.arr) add(e);
+            }
+            size_t closeIdx = tape.words.size();
+            tape.words[openIdx] = tapeWord(isObj ? TapeTag::Object : TapeTag::Array, closeIdx);
+            tape.words.push_back(tapeWord(isObj ? TapeTag::ObjectEnd : TapeTag::ArrayEnd, openIdx));
+        }
+        else if (n.type == "String") tape.words.push_back(tapeWord(TapeTag::String, addString(n.value)));
+        else if (n.type == "Number") tape.words.push_back(tapeWord(TapeTag::Number, addString(n.value)));
+        else if (n.type == "Bool") tape.words.push_back(tapeWord(n.value == "true" ? TapeTag::True : TapeTag::False, 0));
+        else tape.words.push_back(tapeWord(TapeTag::Null, 0));
+    }
+};
+
+Tape buildTape(const Node &root, const KeyTable &keys) {
+    Tape tape;
+    TapeBuilder b{tape, keys, {}};
+    b.add(root);
+    return tape;
+}
+
+// Checks every offset and container link so a corrupt file cannot make the
+// accessors read out of bounds
+bool validateTape(const TapeView &t) {
+    if (t.size == 0) return false;
+    for (size_t i = 0; i < t.size; i++) {
+        TapeRef r{&t, i};
+        uint64_t p = r.payload();
+        switch (r.tag()) {
+            case TapeTag::Object:
+            case TapeTag::Array:
+                if (p <= i || p >= t.size || (t.words[p] & TAPE_PAYLOAD_MASK) != i) return false;
+                if (TapeRef{&t, p}.tag() != (r.isObject() ? TapeTag::ObjectEnd : TapeTag::ArrayEnd)) return false;
+                break;
+            case TapeTag::ObjectEnd:
+            case TapeTag::ArrayEnd:
+                if (p >= i || (t.words[p] & TAPE_PAYLOAD_MASK) != i) return false;
+                break;
+            case TapeTag::String:
+            case TapeTag::Number: {
+                if (p > t.stringsSize || t.stringsSize - p < sizeof(uint32_t)) return false;
+                uint32_t len;
+                memcpy(&len, t.strings + p, sizeof(len));
+                if (t.stringsSize - p - sizeof(uint32_t) < len) return false;
+                break;
+            }
+            case TapeTag::True:
+            case TapeTag::False:
+            case TapeTag::Null:
+                break;
+            default:
+                return false;
+        }
+    }
+    return TapeRef{&t, 0}.next().idx == t.size;
+}
+
+// On-disk layout: header, tape words, string buffer. Words are stored in host
+// byte order, so files are only portable between machines of equal endianness.
+struct TapeFileHeader {
+    char magic[8];
+    uint64_t words;
+    uint64_t stringBytes;
+};
+
+const char TAPE_MAGIC[8] = {'J', 'S', 'O', 'N', 'T', 'A', 'P', '1'};
+
+bool saveTape(const Tape &tape, const string &path) {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) return false;
+    TapeFileHeader h;
+    memcpy(h.magic, TAPE_MAGIC, sizeof(h.magic));
+    h.words = tape.words.size();
+    h.stringBytes = tape.strings.size();
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(tape.words.data()), tape.words.size() * sizeof(uint64_t));
+    out.write(tape.strings.data(), tape.strings.size());
+    return bool(out);
+}
+
+// A tape file mapped read-only into memory; values are read in place
+struct MappedTape {
+    void *base = nullptr;
+    size_t length = 0;
+    TapeView view;
+
+    MappedTape() = default;
+    MappedTape(const MappedTape&) = delete;
+    MappedTape &operator=(const MappedTape&) = delete;
+    ~MappedTape() { unmap(); }
+
+    void unmap() {
+        if (base) munmap(base, length);
+        base = nullptr;
+        length = 0;
+        view = TapeView();
+    }
+
+    TapeRef root() const { return {&view, 0}; }
+};
+
+bool loadTape(const string &path, MappedTape &out) {
+    out.unmap();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(TapeFileHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t length = st.st_size;
+    void *base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+    out.base = base;
+    out.length = length;
+
+    TapeFileHeader h;
+    memcpy(&h, base, sizeof(h));
+    size_t body = length - sizeof(h);
+    if (memcmp(h.magic, TAPE_MAGIC, sizeof(h.magic)) != 0 ||
+        h.words > body / sizeof(uint64_t) ||
+        h.stringBytes != body - h.words * sizeof(uint64_t)) {
+        std::cerr << "[Tape] Not a valid tape file: " << path << "\n";
+        out.unmap();
+        return false;
+    }
+
+    const char *p = static_cast<const char*>(base) + sizeof(h);
+    out.view.words = reinterpret_cast<const uint64_t*>(p);
+    out.view.size = h.words;
+    out.view.strings = p + h.words * sizeof(uint64_t);
+    out.view.stringsSize = h.stringBytes;
+    if (!validateTape(out.view)) {
+        std::cerr << "[Tape] Corrupt tape file: " << path << "\n";
+        out.unmap();
+        return false;
+    }
+    return true;
+}
+
+// ---- Columnar extraction from NDJSON ----
+//
+// Walks the structural index of a stream of JSON objects and writes only the
+// requested fields into typed column buffers. Unrequested fields are skipped
+// by jumping over their structurals, so no tokens or Nodes are built.
+
+enum class ColumnType { Int64, Double, Bool, String };
+
+struct ColumnSpec {
+    string path; // dotted field path, e.g. "user.id"
+    ColumnType type;
+};
+
+struct Column {
+    string path;
+    ColumnType type;
+    size_t rows = 0;
+    vector<int64_t> ints;
+    vector<double> doubles;
+    vector<uint8_t> bools;
+    vector<uint32_t> offsets{0}; // String: row r is data[offsets[r], offsets[r + 1])
+    string data;                 // String: raw bytes between the quotes, escapes kept
+    vector<uint64_t> validity;   // bit r set when row r holds a value of this type
+
+    bool isValid(size_t row) const { return (validity[row / 64] >> (row % 64)) & 1; }
+};
+
+struct ColumnExtractor {
+    // Requested paths as a trie; column is -1 for pure prefixes
+    struct PathNode {
+        vector<pair<string, size_t>> children;
+        int column = -1;
+    };
+
+    const string &json;
+    const vector<size_t> &s; // structurals
+    size_t i = 0;
+    vector<PathNode> trie{PathNode()};
+    vector<Column> columns;
+    vector<string_view> pendingStrings; // String columns are committed at row end
+
+    ColumnExtractor(const string &json, const vector<size_t> &structurals, const vector<ColumnSpec> &specs)
+        : json(json), s(structurals) {
+        for (auto &spec : specs) {
+            size_t node = 0;
+            size_t start = 0;
+            while (true) {
+                size_t dot = spec.path.find('.', start);
+                string part = spec.path.substr(start, dot == string::npos ? string::npos : dot - start);
+                size_t next = SIZE_MAX;
+                for (auto &c : trie[node].children) {
+                    if (c.first == part) next = c.second;
+                }
+                if (next == SIZE_MAX) {
+                    next = trie.size();
+                    trie[node].children.push_back({part, next});
+                    trie.emplace_back();
+                }
+                node = next;
+                if (dot == string::npos) break;
+                start = dot + 1;
+            }
+            if (trie[node].column >= 0) throw runtime_error("Duplicate column path: " + spec.path);
+            trie[node].column = columns.size();
+            columns.push_back({spec.path, spec.type});
+        }
+        pendingStrings.resize(columns.size());
+    }
+
+    char at() const {
+        if (i >= s.size()) throw runtime_error("Unexpected end of input in NDJSON record");
+        return json[s[i]];
+    }
+
+    void expect(char c) {
+        if (at() != c) throw runtime_error(string("Expected '") + c + "' in NDJSON record");
+        i++;
+    }
+
+    // i is at an opening quote; returns the string body and moves past the closing quote
+    string_view skipString() {
+        size_t start = s[i] + 1;
+        while (++i < s.size()) {
+            size_t q = s[i];
+            if (json[q] != '"') continue;
+            size_t slashes = 0;
+            while (q - slashes > start && json[q - slashes - 1] == '\\') slashes++;
+            if (slashes % 2 == 0) {
+                i++;
+                return string_view(json.data() + start, q - start);
+            }
+        }
+        throw runtime_error("Unterminated string in NDJSON record");
+    }
+
+    // i is at '{' or '['; moves past the matching close
+    void skipContainer() {
+        int depth = 0;
+        do {
+            char c = at();
+            if (c == '"') { skipString(); continue; }
+            if (c == '{' || c == '[') depth++;
+            else if (c == '}' || c == ']') depth--;
+            i++;
+        } while (depth > 0);
+    }
+
+    // Text of a number or literal sitting between the previous structural and s[i]
+    string_view scalarBefore() const {
+        size_t b = s[i - 1] + 1, e = i < s.size() ? s[i] : json.size();
+        while (b < e && isspace(json[b])) b++;
+        while (e > b && isspace(json[e - 1])) e--;
+        return string_view(json.data() + b, e - b);
+    }
+
+    void setValid(Column &col) {
+        size_t row = col.rows - 1;
+        col.validity[row / 64] |= uint64_t(1) << (row % 64);
+    }
+
+    void storeScalar(int column, string_view text) {
+        Column &col = columns[column];
+        size_t row = col.rows - 1;
+        switch (col.type) {
+            case ColumnType::Int64: {
+                auto r = from_chars(text.data(), text.data() + text.size(), col.ints[row]);
+                if (r.ec == errc() && r.ptr == text.data() + text.size()) setValid(col);
+                break;
+            }
+            case ColumnType::Double: {
+                auto r = from_chars(text.data(), text.data() + text.size(), col.doubles[row]);
+                if (r.ec == errc() && r.ptr == text.data() + text.size()) setValid(col);
+                break;
+            }
+            case ColumnType::Bool:
+                if (text == "true" || text == "false") {
+                    col.bools[row] = text == "true";
+                    setValid(col);
+                }
+                break;
+            case ColumnType::String:
+                break; // numbers and literals are not strings
+        }
+    }
+
+    // JSON number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    static bool isJsonNumber(string_view t) {
+        size_t k = 0;
+        auto digits = [&]() {
+            size_t start = k;
+            while (k < t.size() && isdigit(t[k])) k++;
+            return k > start;
+        };
+        if (k < t.size() && t[k] == '-') k++;
+        if (k < t.size() && t[k] == '0') k++;
+        else if (!digits()) return false;
+        if (k < t.size() && t[k] == '.') {
+            k++;
+            if (!digits()) return false;
+        }
+        if (k < t.size() && (t[k] == 'e' || t[k] == 'E')) {
+            k++;
+            if (k < t.size() && (t[k] == '+' || t[k] == '-')) k++;
+            if (!digits()) return false;
+        }
+        return k == t.size();
+    }
+
+    void value(size_t node) {
+        int column = node == SIZE_MAX ? -1 : trie[node].column;
+        string_view scalar = scalarBefore();
+        if (!scalar.empty()) {
+            if (scalar != "true" && scalar != "false" && scalar != "null" && !isJsonNumber(scalar)) {
+                throw runtime_error("Invalid value in NDJSON record: " + string(scalar));
+            }
+            if (column >= 0) storeScalar(column, scalar);
+            return;
+        }
+        char c = at();
+        if (c == '"') {
+            string_view str = skipString();
+            if (column >= 0 && columns[column].type == ColumnType::String) {
+                pendingStrings[column] = str;
+                setValid(columns[column]);
+            }
+        } else if (c == '{' && node != SIZE_MAX && !trie[node].children.empty()) {
+            object(node);
+        } else if (c == '{' || c == '[') {
+            skipContainer();
+        } else {
+            throw runtime_error("Expected value in NDJSON record");
+        }
+    }
+
+    // i is at '{'; node is the trie node for this object, or SIZE_MAX if unrequested
+    void object(size_t node) {
+        expect('{');
+        if (at() == '}') { i++; return; }
+        while (true) {
+            if (at() != '"') throw runtime_error("Expected string key in NDJSON record");
+            string_view key = skipString();
+            expect(':');
+            size_t child = SIZE_MAX;
+            for (auto &c : trie[node].children) {
+                if (c.first == key) child = c.second;
+            }
+            value(child);
+            char c = at();
+            i++;
+            if (c == '}') return;
+            if (c != ',') throw runtime_error("Expected ',' or '}' in NDJSON record");
+        }
+    }
+
+    void beginRow() {
+        for (auto &col : columns) {
+            size_t row = col.rows++;
+            if (row % 64 == 0) col.validity.push_back(0);
+            switch (col.type) {
+                case ColumnType::Int64: col.ints.push_back(0); break;
+                case ColumnType::Double: col.doubles.push_back(0); break;
+                case ColumnType::Bool: col.bools.push_back(0); break;
+                case ColumnType::String: break;
+            }
+        }
+        fill(pendingStrings.begin(), pendingStrings.end(), string_view());
+    }
+
+    void endRow() {
+        for (size_t c = 0; c < columns.size(); c++) {
+            Column &col = columns[c];
+            if (col.type != ColumnType::String) continue;
+            col.data.append(pendingStrings[c].data(), pendingStrings[c].size());
+            col.offsets.push_back(col.data.size());
+        }
+    }
+
+    void run() {
+        size_t gapStart = 0;
+        while (i < s.size()) {
+            for (size_t p = gapStart; p < s[i]; p++) {
+                if (!isspace(json[p])) throw runtime_error("NDJSON record is not an object");
+            }
+            if (json[s[i]] != '{') throw runtime_error("NDJSON record is not an object");
+            beginRow();
+            object(0);
+            endRow();
+            gapStart = s[i - 1] + 1;
+        }
+        for (size_t p = gapStart; p < json.size(); p++) {
+            if (!isspace(json[p])) throw runtime_error("NDJSON record is not an object");
+        }
+    }
+};
+
+// Splits an NDJSON buffer of objects into one typed column per requested
+// path. Missing fields, nulls and values of the wrong type leave the row's
+// validity bit clear. Throws on malformed structure and on numbers or
+// literals that are not valid JSON, requested or not; string contents
+// (escapes) are not checked. Listing the same path twice in specs throws.
+vector<Column> extractColumns(const string &ndjson, const vector<ColumnSpec> &specs) {
+    auto structurals = find_structurals(ndjson);
+    ColumnExtractor ex(ndjson, structurals, specs);
+    ex.run();
+    return std::move(ex.columns);
+}
+
+// ---- Minify / re-indent straight from the input bytes ----
+//
+// Both run the stage 1 StringScanner over the raw text and never build a
+// tree. They do not validate: malformed input is reformatted as far as the
+// string state allows.
+
+// Appends the bytes of block whose bit is set in keep, copying whole runs at once
+void compressBlock(string &out, const char *block, uint64_t keep, size_t len) {
+    if (len < 64) keep &= (uint64_t(1) << len) - 1;
+    if (keep == UINT64_MAX) {
+        out.append(block, 64);
+        return;
+    }
+    while (keep) {
+        int start = __builtin_ctzll(keep);
+        uint64_t rest = ~keep & (UINT64_MAX << start);
+        int end = rest ? __builtin_ctzll(rest) : 64;
+        out.append(block + start, end - start);
+        keep = end == 64 ? 0 : keep & (UINT64_MAX << end);
+    }
+}
+
+// Strips all whitespace outside strings
+string minifyJson(const string &json) {
+    string out;
+    out.reserve(json.size());
+    StringScanner scanner;
+    for (size_t i = 0; i < json.size(); i += 64) {
+        size_t len = min<size_t>(64, json.size() - i);
+        BlockMasks m = scanner.next(json.data() + i, len);
+        compressBlock(out, json.data() + i, ~(m.space & ~m.inString), len);
+    }
+    return out;
+}
+
+// Re-indents with `indent` spaces per level. The layout follows printNode,
+// except that empty containers stay on one line as {} and [] where
+// printNode prints {\n} and [\n]. Unbalanced closers are copied through with
+// the depth clamped at 0, and a negative indent is treated as 0.
+string reindentJson(const string &json, int indent = 2) {
+    string out;
+    out.reserve(json.size() + json.size() / 2);
+    int depth = 0;
+    bool afterOpen = false; // last output was '{' or '[' and no newline emitted yet
+    bool needNewline = false;
+
+    auto newline = [&]() {
+        out += '\n';
+        out.append(size_t(depth) * size_t(max(indent, 0)), ' ');
+    };
+
+    StringScanner scanner;
+    for (size_t i = 0; i < json.size(); i += 64) {
+        size_t len = min<size_t>(64, json.size() - i);
+        const char *block = json.data() + i;
+        BlockMasks m = scanner.next(block, len);
+        uint64_t special = (m.space | m.structural) & ~m.inString;
+        if (len < 64) special &= (uint64_t(1) << len) - 1;
+        uint64_t plain = ~special;
+        if (len < 64) plain &= (uint64_t(1) << len) - 1;
+
+        size_t k = 0;
+        while (k < len) {
+            if (plain >> k & 1) {
+                // run of string or scalar bytes
+                uint64_t rest = special & (UINT64_MAX << k);
+                size_t end = rest ? __builtin_ctzll(rest) : len;
+                if (needNewline) { newline(); needNewline = false; }
+                afterOpen = false;
+                out.append(block + k, end - k);
+                k = end;
+                continue;
+            }
+            char c = block[k++];
+            switch (c) {
+                case '{':
+                case '[':
+                    if (needNewline) newline();
+                    out += c;
+                    depth++;
+                    afterOpen = true;
+                    needNewline = true;
+                    break;
+                case '}':
+                case ']':
+                    if (depth > 0) depth--;
+                    if (!afterOpen) newline();
+                    out += c;
+                    afterOpen = false;
+                    needNewline = false;
+                    break;
+                case ',':
+                    out += ',';
+                    needNewline = true;
+                    break;
+                case ':':
+                    out += ": ";
+                    break;
+                default:
+                    break; // whitespace
+            }
+        }
+    }
+    return out;
+}
+
 // int main() {
 //     string json = R"({
 //         "name": "Alice",
@@ -360,7 +1400,7 @@ bool parseSimd(const string &json) {
 //     Node root = p.parseValue();
 
 //     cout << "Parsed JSON Tree:\n";
-//     printNode(root);
+//     printNode(root, p.table());
 //     cout << "\n\n";
 
 //     cout << "parseSimd() returned: " << (parseSimd(json) ? "true" : "false") << "\n";